@@ -9,6 +9,10 @@ output.create_output_database()
 # Empty task list
 task = ["", ""]
 
+# Select the fastest kernel variant for this machine before each computation; the choice is
+# recorded in output_database/kernel_tuning.txt, hence it is only needed once per machine type
+autotune = False
+
 # Run computations for the selected initial conditions and grid resolutions
 for initial_condition in output.initial_conditions:
  for flux in output.fluxes:
@@ -16,7 +20,17 @@ for initial_condition in output.initial_conditions:
   task[1] = flux
   # Practical range is from k = 6 to k = 17
   for k in range(6,10):
+   if autotune:
+    subprocess.call(["./compute_task", *task, str(k), "Autotune"])
    subprocess.call(["./compute_task", *task, str(k)])
+  # Alternatively, let compute_task refine the grid (up to k = 16) until the estimated error meets a target, e.g.
+  # subprocess.call(["./compute_task", *task, "16", "Target_Accuracy", "sup_norm", "1e-3"])
+
+# Run computations for the inviscid Burgers' equation
+for initial_condition in output.initial_conditions:
+ for flux in output.nonlinear_fluxes:
+  for k in range(6,10):
+   subprocess.call(["./compute_task", initial_condition, flux, str(k)])
 
 # Process the results for the selected initial conditions and grid resolutions
 for initial_condition in output.initial_conditions:
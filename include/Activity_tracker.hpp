@@ -0,0 +1,110 @@
+#include <cmath>
+#include <vector>
+#include <utility>
+
+/*
+ * NOTE:
+ * The grid is divided into blocks of block_size cells. A block is "hot" if any of its cells exceeds the
+ * activity threshold in absolute value, and "active" if it is hot or adjacent to a hot block. Only the
+ * active blocks are swept by the flux and update kernels (see sparse_timestep in Compute_task.hpp).
+ *
+ * The bitmap of hot blocks is rebuilt from the field every rebuild_period timesteps. In between, the one-block
+ * margin on each side of the hot region contains everything the solution can reach: every flux stencil reads
+ * at most two cells on each side of an edge, hence a cell update depends on cells at most two cells away, and
+ * within rebuild_period = block_size/2 timesteps the influence of a hot block travels at most one block in
+ * either direction. The physical displacement (at most CFL < 1 cells per timestep) is contained in it as well,
+ * so the active region follows the advected profile without an explicit shift.
+ *
+ * Skipping the quiescent blocks is not exactly conservative: the fluxes across the boundary of an active
+ * region change the active cells but not the frozen ones. The resulting change of mass is accumulated exactly
+ * (skipped_mass) together with its bound (sum of the absolute values of the boundary contributions), and both
+ * scale with the activity threshold.
+*/
+
+class Activity_tracker {
+public:
+  Activity_tracker(unsigned int M = 0, double threshold = 0) :
+	   M(M),
+	   threshold(threshold),
+	   blocks(M/block_size),
+	   hot(M/block_size),
+	   runs(),
+	   step(0),
+	   active_cells(0),
+	   active_cells_per_step(0),
+	   skipped_mass(0),
+	   skipped_mass_bound(0)
+	   {};
+
+  ~Activity_tracker() {};
+
+// Number of cells in one block; the grids have at least 2^6 = 64 cells
+  static constexpr unsigned int block_size = 64;
+// Number of timesteps between two rebuilds of the bitmap
+  static constexpr unsigned int rebuild_period = block_size/2;
+
+// Ranges of cells [first, last) formed by consecutive active blocks, rebuilt from the field if it is due
+  const std::vector<std::pair<unsigned int, unsigned int>> & active_runs(const double * field)
+  {
+    if (step % rebuild_period == 0)
+      rebuild(field);
+    ++step;
+
+    active_cells += active_cells_per_step;
+    return runs;
+  };
+
+// Record the change of mass caused by the fluxes across the boundary of an active run (h*t/h*flux = t*flux)
+  void skip_boundary_fluxes(double time_step, double flux_in, double flux_out)
+  {
+    skipped_mass += time_step*(flux_in - flux_out);
+    skipped_mass_bound += time_step*(std::abs(flux_in) + std::abs(flux_out));
+  };
+
+// Fraction of the cell updates that have been executed
+  double active_fraction() const { return (step > 0) ? double(active_cells)/(double(step)*M) : 1; };
+  double mass_skipped() const { return skipped_mass; };
+  double mass_skipped_bound() const { return skipped_mass_bound; };
+
+private:
+  void rebuild(const double * field)
+  {
+    for (unsigned int block = 0; block < blocks; ++block)
+      {
+	double block_max = 0;
+	for (unsigned int i = block*block_size; i < (block+1)*block_size; ++i)
+	  block_max = std::max(block_max, std::abs(field[i]));
+	hot[block] = (block_max > threshold);
+      }
+
+// Active blocks: hot blocks and their periodic neighbours
+    std::vector<bool> active(blocks);
+    for (unsigned int block = 0; block < blocks; ++block)
+      active[block] = hot[(block+blocks-1)%blocks] or hot[block] or hot[(block+1)%blocks];
+
+// Merge consecutive active blocks into runs of cells
+    runs.clear();
+    active_cells_per_step = 0;
+    for (unsigned int block = 0; block < blocks; ++block)
+      {
+	if (!active[block])
+	  continue;
+	if (!runs.empty() and runs.back().second == block*block_size)
+	  runs.back().second += block_size;
+	else
+	  runs.emplace_back(block*block_size, (block+1)*block_size);
+	active_cells_per_step += block_size;
+      }
+  };
+
+  const unsigned int M;
+  const double threshold;
+  const unsigned int blocks;
+  std::vector<bool> hot;
+  std::vector<std::pair<unsigned int, unsigned int>> runs;
+  unsigned long step;
+  unsigned long active_cells;
+  unsigned long active_cells_per_step;
+  double skipped_mass;
+  double skipped_mass_bound;
+};
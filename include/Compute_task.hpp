@@ -5,12 +5,18 @@
 #include <valarray>
 #include <algorithm>
 #include <chrono>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 #include "boost/math/special_functions/sign.hpp"
 
 #include "H5Cpp.h"
 
 #include "Fluxes.hpp"
+#include "Kernel_tuning.hpp"
+#include "Activity_tracker.hpp"
+#include "Npy_output.hpp"
 
 /** @brief Valid initial condition input strings.  */
 const std::set<std::string> initial_conditions
@@ -31,7 +37,27 @@ const std::set<std::string> fluxes
     "Fromm_van_Leer", 
     "Fromm_van_Leer_CFL_half",
     "Flux_Corrected_Transport", 
-    "Lax_Wendroff_Fourth_Order"    
+    "Lax_Wendroff_Fourth_Order",
+    "Burgers_Godunov",
+    "Burgers_Engquist_Osher",
+    "Burgers_Godunov_Minmod"
+  };
+
+/** @brief Valid optional mode input strings and the number of arguments that follow them. */
+const std::map<std::string, int> modes
+  {
+    {"Autotune", 0},
+    {"Npy", 0},
+    {"Sparse", 1},
+    {"Target_Accuracy", 2}
+  };
+
+/** @brief Valid norm input strings for the target accuracy mode. */
+const std::set<std::string> norms
+  {
+    "sup_norm", 
+    "one_norm", 
+    "two_norm"
   };
 
   /** 
@@ -39,9 +65,17 @@ const std::set<std::string> fluxes
    * 
    * \param argv[1] A string containing the name of the initial condition
    * \param argv[2] A string containing the name of the flux
-   * \param argv[3] Grid refinement exponent, which is related to grid stepsize h as h = 2^(-Refinement_Exponent)
+   * \param argv[3] Grid refinement exponent, which is related to grid stepsize h as h = 2^(-Refinement_Exponent);
+   *                in the target accuracy mode it is the largest refinement exponent that may be used
+   * \param argv[4] Optional mode: "Autotune" selects the fastest kernel variant instead of storing the solution,
+   *                "Npy" stores the solution as a memory-mapped .npy file instead of a dataset of the HDF5 database,
+   *                "Sparse" skips the quiescent regions of the grid, 
+   *                "Target_Accuracy" selects the refinement exponent which meets the target error
+   * \param argv[5] Activity threshold (sparse mode), or norm in which the target error is measured (target accuracy mode)
+   * \param argv[6] Target error (target accuracy mode only)
    * 
-   * @return A map (set of key-value pairs) containing validated initial condition name, flux name, and grid refinement exponent.
+   * @return A map (set of key-value pairs) containing validated initial condition name, flux name, grid refinement exponent, mode,
+   * and the arguments of the mode (activity threshold, or norm and target error).
    */
   
 std::map<std::string, std::string> process_arguments(int& argc, char ** & argv) {
@@ -85,11 +119,61 @@ std::map<std::string, std::string> process_arguments(int& argc, char ** & argv)
 	error_messages_stack.append("\n\tRefinement exponent out of range");
       };
 
+// Error message in case of invalid mode input string
+    auto valid_modes = [&] () -> void 
+      { 
+	std::cout << "###\tERROR:\t" << "\"" << argv[4] << "\" isn't valid mode input!" << std::endl;
+	
+	std::cout << "Valid modes are:" << std::endl;
+	std::for_each(modes.begin(), modes.end(), [](std::pair<const std::string, int> mode){std::cout << "\t \""+ mode.first + "\"" << std::endl;});	
+	std::cout << std::endl;
+	
+	error_messages_stack.append("\n\tInvalid mode input");
+      };
+
+// Error message in case of invalid norm input string
+    auto valid_norms = [&] () -> void 
+      { 
+	std::cout << "###\tERROR:\t" << "\"" << argv[5] << "\" isn't valid norm input!" << std::endl;
+	
+	std::cout << "Valid norms are:" << std::endl;
+	std::for_each(norms.begin(), norms.end(), [](std::string norm){std::cout << "\t \""+ norm + "\"" << std::endl;});	
+	std::cout << std::endl;
+	
+	error_messages_stack.append("\n\tInvalid norm input");
+      };
+
+// Error message in case of invalid activity threshold input 
+    auto valid_threshold = [&] () -> void 
+      { 
+	std::cout << "###\tERROR:\t" << "\"" << argv[5] << "\" isn't valid activity threshold!" << std::endl;
+      	
+	std::cout << "Valid activity thresholds are:" << std::endl;
+	std::cout << "\tPositive numbers" << std::endl;	
+	std::cout << std::endl;
+	
+	error_messages_stack.append("\n\tActivity threshold out of range");
+      };
+
+// Error message in case of invalid target error input 
+    auto valid_target_error = [&] () -> void 
+      { 
+	std::cout << "###\tERROR:\t" << "\"" << argv[6] << "\" isn't valid target error!" << std::endl;
+      	
+	std::cout << "Valid target errors are:" << std::endl;
+	std::cout << "\tPositive numbers" << std::endl;	
+	std::cout << std::endl;
+	
+	error_messages_stack.append("\n\tTarget error out of range");
+      };
+
 // Error message in case of missing or extra arguments       
     auto valid_usage = [&] () -> void 
       { 
       std::cout << "###\tERROR:\t" << "Correct usage is:" << std::endl;
-      std::cout << "\t./run_computation \"Initial Condition\" \"Method\" \"Refinement Exponent\"" << std::endl;   
+      std::cout << "\t./run_computation \"Initial Condition\" \"Method\" \"Refinement Exponent\" [\"Autotune\" | \"Npy\"]" << std::endl;   
+      std::cout << "\t./run_computation \"Initial Condition\" \"Method\" \"Refinement Exponent\" \"Sparse\" \"Activity Threshold\"" << std::endl;   
+      std::cout << "\t./run_computation \"Initial Condition\" \"Method\" \"Maximal Refinement Exponent\" \"Target_Accuracy\" \"Norm\" \"Target Error\"" << std::endl;   
       
       std::cout << std::endl;
       
@@ -100,7 +184,11 @@ std::map<std::string, std::string> process_arguments(int& argc, char ** & argv)
   std::map<std::string, std::string> arguments;
 
 // Case of missing or extra arguments  
-  if (argc != 4)
+  if (argc < 4 or argc > 7)
+    valid_usage();
+
+// Case of a mode with missing or extra arguments  
+  if (argc > 4 and modes.find(argv[4]) != modes.end() and modes.at(argv[4]) != argc - 5)
     valid_usage();
 
 // Case of invalid initial condition input string 
@@ -121,12 +209,265 @@ std::map<std::string, std::string> process_arguments(int& argc, char ** & argv)
   else
     arguments.emplace("refinement_exponent", argv[3]); 
 
+// Case of invalid mode input string; without the optional argument the solution is computed and stored  
+  if (argc > 4 and modes.find(argv[4]) == modes.end())
+    valid_modes();
+  else  
+    arguments.emplace("mode", (argc > 4) ? argv[4] : "Compute"); 
+
+// Case of invalid activity threshold in the sparse mode, or invalid norm or target error input in the target accuracy mode  
+  if (argc == 6)
+    {
+      if (!(std::stod(argv[5]) > 0))
+	valid_threshold();
+      else
+	arguments.emplace("threshold", argv[5]); 
+    }
+  
+  if (argc == 7)
+    {
+      if (norms.find(argv[5]) == norms.end())
+	valid_norms();
+      else
+	arguments.emplace("norm", argv[5]); 
+      
+      if (!(std::stod(argv[6]) > 0))
+	valid_target_error();
+      else
+	arguments.emplace("target_error", argv[6]); 
+    }
+
 // If any errors occured, throw an exception and print the list of occured errors  
   if (!error_messages_stack.empty())
     throw std::out_of_range(error_messages_stack);
     
   return arguments;
   
+};
+
+  /** 
+   * \brief Read the attributes pertaining to the requested computation (CFL number, speed a, output time T) from the data group.
+   */
+
+void read_attributes(H5::Group & output_group, double & S, double & a, double & T) {
+
+// Open attributes as objects  
+  H5::Attribute S_attribute = output_group.openAttribute("CFL");
+  H5::Attribute a_attribute = output_group.openAttribute("a");
+  H5::Attribute T_attribute = output_group.openAttribute("T");
+
+// Write attributes to the variables  
+  S_attribute.read(H5::PredType::NATIVE_DOUBLE, &S);
+  a_attribute.read(H5::PredType::NATIVE_DOUBLE, &a);
+  T_attribute.read(H5::PredType::NATIVE_DOUBLE, &T);
+};
+
+  /** 
+   * \brief Write a double attribute to a data group or dataset, replacing the attribute if it already exists.
+   */
+
+void write_attribute(H5::H5Object & object, const std::string & name, double value) {
+
+  if (object.attrExists(name))
+    object.removeAttr(name);
+
+  H5::Attribute attribute = object.createAttribute(name, H5::PredType::NATIVE_DOUBLE, H5::DataSpace());
+  attribute.write(H5::PredType::NATIVE_DOUBLE, &value);
+};
+
+  /** 
+   * \brief Retrieve the attributes of the computation and its initial data from the database, which is closed on return.
+   * 
+   * HDF5 locks the database while it is open, hence it is not kept open during the computation.
+   * 
+   * \param input_group_path Path to the data group containing the initial data
+   * \param group_path Path to the data group of the computation
+   * \param dataset_initial_data Name of the initial data dataset
+   * \param output_dataset Name of the dataset in which the result will be stored, which must not exist yet;
+   *                       empty if the result is not stored in the database
+   * \param field Array of M doubles which is initialized with the initial data
+   */
+
+void read_initial_data(const std::string & input_group_path, 
+		       const std::string & group_path, 
+		       const std::string & dataset_initial_data, 
+		       const std::string & output_dataset, 
+		       double * field, 
+		       double & S, double & a, double & T) {
+
+  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDONLY);
+  H5::Group input_group = computations_output_file.openGroup(input_group_path);
+  H5::Group output_group = computations_output_file.openGroup(group_path);
+
+// Fail before the computation rather than when its result is written
+  if (!output_dataset.empty() and H5Lexists(output_group.getId(), output_dataset.c_str(), H5P_DEFAULT) > 0)
+    throw std::runtime_error("\n\tDataset \"" + group_path + "/" + output_dataset + "\" already exists");
+
+  read_attributes(output_group, S, a, T);
+
+  H5::DataSet field_initial_dataset = input_group.openDataSet(dataset_initial_data); 
+  field_initial_dataset.read(field, H5::PredType::NATIVE_DOUBLE);
+};
+
+/*
+ * NOTE:
+ * The timestep kernels are instantiated for every grid size M = 2^k (see main.cpp), so that 
+ * the trip counts of the loops over the cells and edges are known at compile time, which allows
+ * the compiler to unroll and vectorize them without remainder handling.
+*/
+
+  /** 
+   * \brief Periodic boundary conditions for the cells: update the two ghost cells on each side of the grid. 
+   */
+
+template<unsigned int M>
+void update_ghost_cells(double * field) {
+
+  field[-1] = field[M-1];
+  field[-2] = field[M-2];
+  field[M] = field[0];
+  field[M+1] = field[1];
+};
+
+  /** 
+   * \brief Compute the fluxes at all edges with the compile-time trip count M. @see Flux_base
+   */
+
+template<unsigned int M, typename Flux>
+void compute_fluxes(const Flux & update_flux, double * fluxes, std::true_type) {
+
+  update_flux.fluxes_range(0, M);
+// Periodic boundary condition for fluxes (cells 0 and M are identical) 
+  fluxes[M] = fluxes[0];
+};
+
+template<unsigned int M, typename Flux>
+void compute_fluxes(const Flux & update_flux, double *, std::false_type) {
+
+  update_flux.fluxes_grid(std::integral_constant<unsigned int, M>());
+};
+
+  /** 
+   * \brief Tiled timestep for fluxes without local stencil: fall back to the split timestep. 
+   */
+
+template<unsigned int M, typename Flux>
+void tiled_timestep(const Flux & update_flux, double * field, double * fluxes, const double t_over_h, const unsigned int, std::false_type) {
+
+  compute_fluxes<M>(update_flux, fluxes, std::false_type());
+  for(unsigned int i = 0; i < M; ++i) 
+    field[i] += t_over_h*(fluxes[i] - fluxes[i+1]);
+};
+
+  /** 
+   * \brief Tiled timestep: compute the fluxes and update the cells tile by tile.
+   * 
+   * The fluxes of the next tile are computed before the current tile is updated, 
+   * since the stencil of the first edges of the next tile reaches into the current tile
+   * and has to see the field from the previous timestep.
+   */
+
+template<unsigned int M, typename Flux>
+void tiled_timestep(const Flux & update_flux, double * field, double * fluxes, const double t_over_h, const unsigned int tile, std::true_type) {
+
+  update_flux.fluxes_range(0, std::min(tile, M));
+  
+  for(unsigned int first = 0; first < M; first += tile) 
+    {
+      const unsigned int last = std::min(first + tile, M);
+      
+      if (last < M)
+	update_flux.fluxes_range(last, std::min(last + tile, M));
+      else
+// Periodic boundary condition for fluxes (cells 0 and M are identical) 
+	fluxes[M] = fluxes[0];
+      
+      for(unsigned int i = first; i < last; ++i) 
+	field[i] += t_over_h*(fluxes[i] - fluxes[i+1]);
+    }
+};
+
+  /** 
+   * \brief Advance the scalar field by one timestep using the given kernel variant.
+   * 
+   * \tparam M Number of cells in the discretization of the grid
+   * \param tile Tile size of the kernel variant, 0 for the split variant @see tile_size
+   * \param output Array into which the updated scalar field is written, e.g. the mapped pages of a .npy file @see Npy_output;
+   *               nullptr updates the field in place. The split variant is used whenever the output is not the field.
+   */
+
+template<unsigned int M, typename Flux>
+void timestep(const Flux & update_flux, double * field, double * fluxes, const double t_over_h, const unsigned int tile, double * output = nullptr) {
+
+// Periodic boundary conditions for the cells: update the ghost cells     
+  update_ghost_cells<M>(field);
+
+  if (tile != 0 and output == nullptr)
+    {
+      tiled_timestep<M>(update_flux, field, fluxes, t_over_h, tile, std::integral_constant<bool, Flux::local_stencil>());
+      return;
+    }
+
+// Compute fluxes across the cells 
+  compute_fluxes<M>(update_flux, fluxes, std::integral_constant<bool, Flux::local_stencil>());
+
+  if (output == nullptr)
+    output = field;
+
+// Conservative finite-difference update of the scalar field (e.g. temperature field field)  
+  for(unsigned int i = 0; i < M; ++i) 
+    {    
+/* 
+ * Flux indexing convention: 
+ *   flux[i] is flux INTO the i-th cell
+ *   -flux[i+1] is flux OUT OF the i-th cell <--> flux[i+1] is flux INTO (i+1)-th cell
+ * The flux balance for i-th cell is thus
+ *   flux[i] - flux[i+1]
+*/
+      output[i] = field[i] + t_over_h*(fluxes[i] - fluxes[i+1]);
+    }
+};
+
+  /** 
+   * \brief Sparse timestep for fluxes without local stencil: all cells are updated. 
+   */
+
+template<unsigned int M, typename Flux>
+void sparse_timestep(const Flux & update_flux, double * field, double * fluxes, const double t_over_h, Activity_tracker &, std::false_type) {
+
+  timestep<M>(update_flux, field, fluxes, t_over_h, 0);
+};
+
+  /** 
+   * \brief Sparse timestep: compute the fluxes and update the cells only in the active regions of the grid. 
+   * 
+   * Runs of active cells are separated by at least one quiescent block, which is wider than the flux stencil,
+   * hence updating one run does not affect the fluxes of the next one. @see Activity_tracker
+   */
+
+template<unsigned int M, typename Flux>
+void sparse_timestep(const Flux & update_flux, double * field, double * fluxes, const double t_over_h, Activity_tracker & tracker, std::true_type) {
+
+// Periodic boundary conditions for the cells: update the ghost cells     
+  update_ghost_cells<M>(field);
+
+  const std::vector<std::pair<unsigned int, unsigned int>> & runs = tracker.active_runs(field);
+// Edges 0 and M are not a boundary of the active region if the runs at both ends of the grid are joined periodically  
+  const bool periodic_run = !runs.empty() and runs.front().first == 0 and runs.back().second == M;
+
+  for (const std::pair<unsigned int, unsigned int> & run : runs)
+    {
+// Fluxes at the edges [first, last], including both boundary edges of the run  
+      update_flux.fluxes_range(run.first, run.second + 1);
+      
+      for(unsigned int i = run.first; i < run.second; ++i) 
+	field[i] += t_over_h*(fluxes[i] - fluxes[i+1]);
+      
+// The boundary fluxes change the active cells, but not the frozen cells on the other side; t = (t/h)/M   
+      tracker.skip_boundary_fluxes(t_over_h/M, 
+				   (periodic_run and run.first == 0) ? 0 : fluxes[run.first], 
+				   (periodic_run and run.second == M) ? 0 : fluxes[run.second]);
+    }
 };
 
   /** 
@@ -154,11 +495,14 @@ std::map<std::string, std::string> process_arguments(int& argc, char ** & argv)
    * variables of the function apart from the other operations taking place in the function, which
    * is more error prone.
    * 
+   * \tparam refinement_exponent Grid refinement exponent k, which determines the number of cells M = 2^k at compile time
    * \param arguments Map containing valid initial condition name, flux name, and grid refinement exponent
+   * 
+   * @return Final state of the scalar field
    */
 
-template<typename Flux>
-void main_loop(std::map<std::string, std::string> & arguments) {
+template<typename Flux, unsigned int refinement_exponent>
+std::valarray<double> main_loop(std::map<std::string, std::string> & arguments) {
  
 // Path to the initial data group where the initial data dataset is stored  
   std::string input_group_path = "/" + arguments["initial_condition"];
@@ -168,58 +512,105 @@ void main_loop(std::map<std::string, std::string> & arguments) {
   std::string dataset_name = "k = " + arguments["refinement_exponent"];
 // Path to the initial data dataset containing the initial data 
   std::string dataset_initial_data = dataset_name + " initial_data";
+// Npy mode: the solution is stored as a .npy file, the database is only read  
+  const bool npy_output = (arguments["mode"] == "Npy");
+// Sparse mode: skip the quiescent regions of the grid (only for fluxes with local stencil)  
+  const bool sparse = (arguments["mode"] == "Sparse") and Flux::local_stencil;
+// The approximate result of the sparse mode is stored apart from the solution used by the convergence tables and the target accuracy mode  
+  if (sparse)
+    dataset_name += " sparse";
 
-// Open the computational database  
-  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDWR);
-
-// Data group containing the initial data  
-  H5::Group input_group = computations_output_file.openGroup(input_group_path);
-// Data group where the dataset containing results of the computation will be stored  
-  H5::Group output_group = computations_output_file.openGroup(group_path);
+// Number of cells in the discretization of the grid  
+  constexpr unsigned int M = 1u << refinement_exponent;
 
-// Grid refinement exponent  
-  const unsigned int refinement_exponent = std::stoi(arguments["refinement_exponent"]);
+// Allocate memory for the scalar field plus four ghost cells  
+std::valarray<double> _field(M+4);
+// Allocate memory for fluxes at the edges of the cells: there are M+1 edges for M cells
+std::valarray<double> _fluxes(M+1);
+// Shift the pointer to the beginning of the array to allow for indeces in the range [-2, M+1]
+  double * field = &_field[0]+2;
+// Pointer to the beginning of the array of fluxes: needed in order to use the flux data globally  
+  double * fluxes = &_fluxes[0];
 
-// Retreive the attributes pertaining to the requested computation, e.g. CFL number
+// Retreive the attributes pertaining to the requested computation, e.g. CFL number, and the initial data; the database is closed afterwards
   
-// Open attributes as objects  
-  H5::Attribute S_attribute = output_group.openAttribute("CFL");
-  H5::Attribute a_attribute = output_group.openAttribute("a");
-  H5::Attribute T_attribute = output_group.openAttribute("T");
-
 // Variables to store the attributes temporarily (buffer)  
   double _S;
   double _a;
   double _T;
 
-// Write attributes to the temporary variables  
-  S_attribute.read(H5::PredType::NATIVE_DOUBLE, &_S);
-  a_attribute.read(H5::PredType::NATIVE_DOUBLE, &_a);
-  T_attribute.read(H5::PredType::NATIVE_DOUBLE, &_T);
+  read_initial_data(input_group_path, group_path, dataset_initial_data, npy_output ? "" : dataset_name, field, _S, _a, _T);
 
 // Store attributes as constants  
   const double S = _S;
   const double a = _a;
   const double T = _T;
 
-// Number of cells in the discretization of the grid  
-  const unsigned int M = pow(2, refinement_exponent);
 // t\h, a constant used in the conservative finite-difference update of the scalar field  
   const double t_over_h = S/a;
 // Number of timesteps required to compute the solution with the given parameters: N = T/t = T*M/(t/h)  
   const unsigned int N = std::floor(T*M/t_over_h+0.5);
 
-// Allocate memory for the scalar field plus four ghost cells  
-std::valarray<double> _field(M+4);
-// Allocate memory for fluxes at the edges of the cells: there are M+1 edges for M cells
-std::valarray<double> _fluxes(M+1);
-// Shift the pointer to the beginning of the array to allow for indeces in the range [-2, M+1]
-  double * field = &_field[0]+2;
-// Pointer to the beginning of the array of fluxes: needed in order to use the flux data globally  
-  double * fluxes = &_fluxes[0];
-
 // Initialize the function object used to compute the fluxes with the public data   
   Flux update_flux {M, S, a, fluxes, field};
+
+// Kernel variant selected by the autotuner for this machine, flux and grid size  
+  const std::string variant = load_kernel_variant(arguments["flux"], arguments["refinement_exponent"], Flux::local_stencil, M);
+  const unsigned int tile = tile_size(variant);
+
+  Activity_tracker tracker(M, sparse ? std::stod(arguments["threshold"]) : 0);
+  
+  if (arguments["mode"] == "Sparse" and !sparse)
+    std::cout << group_path << "/" << dataset_name << ": the flux has no local stencil, all cells will be updated" << std::endl;  
+
+// Indicate that computation has started to the user  
+std::cout << group_path << "/" << dataset_name << ": computation in progress (kernel: " << (sparse ? "sparse" : variant) << ")" << std::endl;  
+// Mark the time of the beginning of the computation
+auto t_0 = std::chrono::system_clock::now();  
+
+// In npy mode the last timestep is written directly into the .npy file  
+const unsigned int N_field = (npy_output and N > 0) ? N-1 : N;
+
+// Main computational loop: iterate over all timestep
+for (unsigned int t = 0; t < N_field; ++t) 
+  {
+    if (sparse)
+      sparse_timestep<M>(update_flux, field, fluxes, t_over_h, tracker, std::integral_constant<bool, Flux::local_stencil>());
+    else
+      timestep<M>(update_flux, field, fluxes, t_over_h, tile);
+  }
+
+  if (npy_output)
+    {
+      Npy_output npy_file(arguments["initial_condition"] + "_" + arguments["flux"] + "_k_" + arguments["refinement_exponent"] + ".npy", M);
+      
+      if (N > 0)
+	timestep<M>(update_flux, field, fluxes, t_over_h, tile, npy_file.data());
+      else
+	std::copy(field, field + M, npy_file.data());
+
+      auto t_1 = std::chrono::system_clock::now();
+
+      std::valarray<double> solution(npy_file.data(), M);
+      npy_file.commit(S, a, T);
+      
+      std::cout << group_path << "/" << dataset_name << ": computation completed in " << std::chrono::duration_cast<std::chrono::seconds>(t_1-t_0).count() << " seconds, stored in " << npy_directory << std::endl;
+      
+      return solution;
+    }
+
+// Mark the time when computation has been completed
+auto t_1 = std::chrono::system_clock::now();
+
+// Compute to time of the computation in seconds
+auto execution_time_seconds = std::chrono::duration_cast<std::chrono::seconds>(t_1-t_0).count();
+// Compute to time of the computation in minutes
+auto execution_time_minutes = std::chrono::duration_cast<std::chrono::minutes>(t_1-t_0).count();
+
+// Open the computational database  
+  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDWR);
+// Data group where the dataset containing results of the computation will be stored  
+  H5::Group output_group = computations_output_file.openGroup(group_path);
 /*
  * Array of dimensions of the datasets stored in the database: in this case, it is one dimensional array of length M. 
  * In general, the i-th component is the length of the i-th dimension of the array that one wishes to store in a HDF5 file.  
@@ -234,57 +625,402 @@ std::valarray<double> _fluxes(M+1);
 
 // Dataset object corresponding to the dataset in which the scalar field will be stored  
   H5::DataSet field_dataset = output_group.createDataSet(dataset_name, H5::PredType::NATIVE_DOUBLE, dataspace);
-// Dataset object corresponding to the initial data dataset from which initial data will be retrieved   
-  H5::DataSet field_initial_dataset = input_group.openDataSet(dataset_initial_data); 
 
-// Retrieval of the initial data and storing in in the scalar field array (i.e. initializing the field array with the initial data)   
-  field_initial_dataset.read(field, H5::PredType::NATIVE_DOUBLE);
-  field_initial_dataset.close();
+// Write the results of the computations (final updated state of the scalar field) into the database
+  field_dataset.write(field, H5::PredType::NATIVE_DOUBLE);
+
+// Record the fraction of executed cell updates and the mass change caused by skipping the quiescent regions   
+  if (sparse)
+    {
+      write_attribute(field_dataset, "activity_threshold", std::stod(arguments["threshold"]));
+      write_attribute(field_dataset, "active_fraction", tracker.active_fraction());
+      write_attribute(field_dataset, "skipped_mass", tracker.mass_skipped());
+      write_attribute(field_dataset, "skipped_mass_bound", tracker.mass_skipped_bound());
+      
+      std::cout << group_path << "/" << dataset_name << ": " << 100*tracker.active_fraction() << "% of cell updates executed, skipped mass " << tracker.mass_skipped() << " (bound " << tracker.mass_skipped_bound() << ")" << std::endl;
+    }
+  
+  field_dataset.close();
+
+// Indicate that the computation has completed and the time it took to the user   
+std::cout << group_path << "/" << dataset_name << ": computation completed in " << execution_time_seconds << " seconds (" << execution_time_minutes << " minutes)" << std::endl;
+
+  return std::valarray<double>(field, M);
+};
+
+  /** 
+   * \brief Acquire the initial data and computational attributes from the database, 
+   * solve the nonlinear conservation law with adaptive timestep and output the results to the database.
+   * 
+   * The timestep is chosen so that the CFL number stays constant: t = CFL*h/max|f'(u)|, where the
+   * maximal wave speed is computed in the same sweep as the conservative update of the field. The last 
+   * timestep is shortened to reach the output time T exactly. The speed attribute "a" is not used.
+   * 
+   * Besides the final state of the scalar field (dataset "k = ..."), the sequence of timesteps is stored 
+   * in the dataset "k = ... time_steps" of the same data group.
+   * 
+   * \param arguments Map containing valid initial condition name, flux name, and grid refinement exponent
+   * 
+   * @return Final state of the scalar field
+   */
+
+template<typename Flux, unsigned int refinement_exponent>
+std::valarray<double> main_loop_nonlinear(std::map<std::string, std::string> & arguments) {
+ 
+  std::string input_group_path = "/" + arguments["initial_condition"];
+  std::string group_path = input_group_path + "/" + arguments["flux"]; 
+  std::string dataset_name = "k = " + arguments["refinement_exponent"];
+  std::string dataset_initial_data = dataset_name + " initial_data";
+// Path to the dataset where the sequence of timesteps will be stored  
+  std::string dataset_time_steps = dataset_name + " time_steps";
+  const bool npy_output = (arguments["mode"] == "Npy");
+
+  constexpr unsigned int M = 1u << refinement_exponent;
+
+  std::valarray<double> _field(M+4);
+  std::valarray<double> _fluxes(M+1);
+  double * field = &_field[0]+2;
+  double * fluxes = &_fluxes[0];
+
+  double S;
+  double a;
+  double T;
+
+  read_initial_data(input_group_path, group_path, dataset_initial_data, npy_output ? "" : dataset_name, field, S, a, T);
+
+  Flux update_flux {M, S, a, fluxes, field};
 
-// Indicate that computation has started to the user  
 std::cout << group_path << "/" << dataset_name << ": computation in progress" << std::endl;  
-// Mark the time of the beginning of the computation
 auto t_0 = std::chrono::system_clock::now();  
 
-// Main computational loop: iterate over all timestep
-for (unsigned int t = 0; t < N; ++t) {
+// Sequence of timesteps taken by the computation  
+  std::vector<double> time_steps;
+// Time reached by the computation  
+  double time = 0;
+// Number of cells as a compile-time constant for the flux kernels @see Flux_base  
+  const std::integral_constant<unsigned int, M> grid_size {};
+// Maximal wave speed max|f'(u)| of the current state of the field  
+  double max_wave_speed = update_flux.max_wave_speed(grid_size);
   
+  bool final_step = false;
+  
+  while (!final_step) {
+    
+// Timestep which keeps the CFL number constant; a constant field may be advanced to the output time at once  
+    double time_step = (max_wave_speed > 0) ? S/(M*max_wave_speed) : T - time;
+    if (time_step >= T - time)
+      {
+	time_step = T - time;
+	final_step = true;
+      }
+
 // Periodic boundary conditions for the cells: update the ghost cells     
-  field[-1] = field[M-1];
-  field[-2] = field[M-2];
-  field[M] = field[0];
-  field[M+1] = field[1];
+    update_ghost_cells<M>(field);
 
-// Compute fluxes across the cells 
-  update_flux();
+    update_flux.fluxes_grid(grid_size);
+// Conservative update with t/h = t*M, fused with the computation of the maximal wave speed for the next timestep  
+    max_wave_speed = update_flux.update_field(time_step*M, grid_size);
 
-// Conservative finite-difference update of the scalar field (e.g. temperature field field)  
-  for(unsigned int i = 0; i < M; ++i) 
-    {    
-/* 
- * Flux indexing convention: 
- *   flux[i] is flux INTO the i-th cell
- *   -flux[i+1] is flux OUT OF the i-th cell <--> flux[i+1] is flux INTO (i+1)-th cell
- * The flux balance for i-th cell is thus
- *   flux[i] - flux[i+1]
-*/
-      field[i] += t_over_h*(fluxes[i] - fluxes[i+1]);
-    }
-}
+    time += time_step;
+    time_steps.push_back(time_step);
+  }
 
-// Mark the time when computation has been completed
 auto t_1 = std::chrono::system_clock::now();
-
-// Compute to time of the computation in seconds
 auto execution_time_seconds = std::chrono::duration_cast<std::chrono::seconds>(t_1-t_0).count();
-// Compute to time of the computation in minutes
 auto execution_time_minutes = std::chrono::duration_cast<std::chrono::minutes>(t_1-t_0).count();
 
-// Write the results of the computations (final updated state of the scalar field) into the database
+// Npy mode: store the final state of the scalar field and the sequence of timesteps as .npy files  
+  if (npy_output)
+    {
+      const std::string file_name = arguments["initial_condition"] + "_" + arguments["flux"] + "_k_" + arguments["refinement_exponent"];
+      
+      Npy_output npy_file(file_name + ".npy", M);
+      std::copy(field, field + M, npy_file.data());
+      npy_file.commit(S, a, T);
+      
+      Npy_output npy_time_steps_file(file_name + "_time_steps.npy", time_steps.size());
+      std::copy(time_steps.begin(), time_steps.end(), npy_time_steps_file.data());
+      npy_time_steps_file.commit(S, a, T);
+      
+      std::cout << group_path << "/" << dataset_name << ": computation completed in " << time_steps.size() << " timesteps, " << execution_time_seconds << " seconds (" << execution_time_minutes << " minutes), stored in " << npy_directory << std::endl;
+      
+      return std::valarray<double>(field, M);
+    }
+
+// Write the final state of the scalar field into the database
+  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDWR);
+  H5::Group output_group = computations_output_file.openGroup(group_path);
+  hsize_t dimensions[1] = {M};
+  H5::DataSpace dataspace(1, dimensions); 
+  H5::DataSet field_dataset = output_group.createDataSet(dataset_name, H5::PredType::NATIVE_DOUBLE, dataspace);
   field_dataset.write(field, H5::PredType::NATIVE_DOUBLE);
   field_dataset.close();
 
-// Indicate that the computation has completed and the time it took to the user   
-std::cout << group_path << "/" << dataset_name << ": computation completed in " << execution_time_seconds << " seconds (" << execution_time_minutes << " minutes)" << std::endl;
+// Write the sequence of timesteps into the database  
+  hsize_t time_steps_dimensions[1] = {time_steps.size()};
+  H5::DataSpace time_steps_dataspace(1, time_steps_dimensions); 
+  H5::DataSet time_steps_dataset = output_group.createDataSet(dataset_time_steps, H5::PredType::NATIVE_DOUBLE, time_steps_dataspace);
+  time_steps_dataset.write(time_steps.data(), H5::PredType::NATIVE_DOUBLE);
+  time_steps_dataset.close();
+
+std::cout << group_path << "/" << dataset_name << ": computation completed in " << time_steps.size() << " timesteps, " << execution_time_seconds << " seconds (" << execution_time_minutes << " minutes)" << std::endl;
+
+  return std::valarray<double>(field, M);
+};
+
+  /** 
+   * \brief Select the fastest kernel variant for the requested flux and grid size on this machine and record it in the tuning file.
+   * 
+   * Every available kernel variant is run for a short number of timesteps on the initial data of the requested computation;
+   * the best of several repetitions is taken as the time of the variant. The solution itself is not stored in the database.
+   * 
+   * \param arguments Map containing valid initial condition name, flux name, and grid refinement exponent
+   */
+
+template<typename Flux, unsigned int refinement_exponent>
+void autotune(std::map<std::string, std::string> & arguments) {
 
-};
\ No newline at end of file
+// Number of timed repetitions of every kernel variant  
+  const unsigned int repetitions = 3;
+// Approximate number of cell updates in one repetition  
+  const unsigned int cell_updates = 1 << 22;
+
+  std::string input_group_path = "/" + arguments["initial_condition"];
+  std::string group_path = input_group_path + "/" + arguments["flux"]; 
+  std::string dataset_initial_data = "k = " + arguments["refinement_exponent"] + " initial_data";
+
+// The database is only read, hence several autotuning processes can share it  
+  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDONLY);
+  H5::Group input_group = computations_output_file.openGroup(input_group_path);
+  H5::Group output_group = computations_output_file.openGroup(group_path);
+
+  double S;
+  double a;
+  double T;
+
+  read_attributes(output_group, S, a, T);
+
+  constexpr unsigned int M = 1u << refinement_exponent;
+  const double t_over_h = S/a;
+// Number of timesteps of one repetition: never more than the actual computation requires  
+  const unsigned int N = std::min<unsigned int>(std::floor(T*M/t_over_h+0.5), std::max<unsigned int>(cell_updates/M, 16));
+
+  std::valarray<double> initial_data(M);
+  std::valarray<double> _field(M+4);
+  std::valarray<double> _fluxes(M+1);
+  double * field = &_field[0]+2;
+  double * fluxes = &_fluxes[0];
+
+  H5::DataSet field_initial_dataset = input_group.openDataSet(dataset_initial_data); 
+  field_initial_dataset.read(&initial_data[0], H5::PredType::NATIVE_DOUBLE);
+  field_initial_dataset.close();
+
+  Flux update_flux {M, S, a, fluxes, field};
+
+  std::string fastest_variant;
+  double fastest_time = std::numeric_limits<double>::infinity();
+
+  for (const std::string & variant : kernel_variants(Flux::local_stencil, M))
+    {
+      const unsigned int tile = tile_size(variant);
+      double variant_time = std::numeric_limits<double>::infinity();
+
+      for (unsigned int repetition = 0; repetition < repetitions; ++repetition)
+	{
+	  std::copy(std::begin(initial_data), std::end(initial_data), field);
+
+	  auto t_0 = std::chrono::steady_clock::now();  
+	  for (unsigned int t = 0; t < N; ++t) 
+	    timestep<M>(update_flux, field, fluxes, t_over_h, tile);
+	  auto t_1 = std::chrono::steady_clock::now();
+
+	  variant_time = std::min(variant_time, std::chrono::duration<double>(t_1-t_0).count());
+	}
+
+      std::cout << group_path << "/k = " << arguments["refinement_exponent"] << ": kernel " << variant << " " << variant_time/N*1e6 << " microseconds per timestep" << std::endl;
+
+      if (variant_time < fastest_time)
+	{
+	  fastest_time = variant_time;
+	  fastest_variant = variant;
+	}
+    }
+
+  store_kernel_variant(arguments["flux"], arguments["refinement_exponent"], fastest_variant);
+
+  std::cout << group_path << "/k = " << arguments["refinement_exponent"] << ": selected kernel " << fastest_variant << std::endl;
+};
+
+  /** 
+   * \brief Execute the requested task according to the mode: compute the solution or autotune the kernel.
+   * 
+   * \tparam refinement_exponent Grid refinement exponent k, which determines the number of cells M = 2^k at compile time
+   * \param arguments Map containing valid initial condition name, flux name, grid refinement exponent, and mode
+   * 
+   * @return Final state of the scalar field, or an empty array if the kernel was autotuned
+   */
+
+template<typename Flux, unsigned int refinement_exponent>
+std::valarray<double> execute_task(std::map<std::string, std::string> & arguments, std::false_type) {
+
+  if (arguments["mode"] == "Autotune")
+    {
+      autotune<Flux, refinement_exponent>(arguments);
+      return std::valarray<double>();
+    }
+  
+  return main_loop<Flux, refinement_exponent>(arguments);
+};
+
+  /** 
+   * \brief Execute the requested task for a nonlinear conservation law, which has only the split kernel variant.
+   */
+
+template<typename Flux, unsigned int refinement_exponent>
+std::valarray<double> execute_task(std::map<std::string, std::string> & arguments, std::true_type) {
+
+  if (arguments["mode"] == "Autotune")
+    {
+      std::cout << "/" << arguments["initial_condition"] << "/" << arguments["flux"] << ": nonlinear conservation laws have no kernel variants to tune" << std::endl;
+      return std::valarray<double>();
+    }
+  
+  if (arguments["mode"] == "Sparse")
+    std::cout << "/" << arguments["initial_condition"] << "/" << arguments["flux"] << ": nonlinear conservation laws have no activity tracking, all cells will be updated" << std::endl;
+  
+  return main_loop_nonlinear<Flux, refinement_exponent>(arguments);
+};
+
+template<typename Flux, unsigned int refinement_exponent>
+std::valarray<double> execute_task(std::map<std::string, std::string> & arguments) {
+
+  return execute_task<Flux, refinement_exponent>(arguments, std::integral_constant<bool, Flux::nonlinear>());
+};
+
+  /** 
+   * \brief Grid norm of a function represented as a vector in R^M (same definition as grid_norm in lib_output_processing.py).
+   * 
+   * \param norm Valid norm name @see norms
+   */
+
+double grid_norm(const std::valarray<double> & x, const std::string & norm) {
+
+  const double h = 1.0/x.size();
+
+  if (norm == "sup_norm")
+    return std::abs(x).max();
+  else if (norm == "one_norm")
+    return std::abs(x).sum()*h;
+  else
+    return std::sqrt((x*x).sum()*h);
+};
+
+  /** 
+   * \brief Read the solution for the requested grid size from the database, if it has already been computed.
+   * 
+   * @return True if the dataset exists and the solution has been read
+   */
+
+bool read_solution(std::map<std::string, std::string> & arguments, std::valarray<double> & solution) {
+
+  std::string group_path = "/" + arguments["initial_condition"] + "/" + arguments["flux"]; 
+  std::string dataset_name = "k = " + arguments["refinement_exponent"];
+
+  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDONLY);
+  H5::Group output_group = computations_output_file.openGroup(group_path);
+
+  if (H5Lexists(output_group.getId(), dataset_name.c_str(), H5P_DEFAULT) <= 0)
+    return false;
+
+  solution.resize(1u << std::stoi(arguments["refinement_exponent"]));
+
+  H5::DataSet field_dataset = output_group.openDataSet(dataset_name); 
+  field_dataset.read(&solution[0], H5::PredType::NATIVE_DOUBLE);
+  field_dataset.close();
+
+  return true;
+};
+
+  /** 
+   * \brief Refine the grid until the estimated error in the requested norm meets the target error.
+   * 
+   * The computations are executed for k = 6, 7, ... up to the refinement exponent given in the task (solutions that are 
+   * already stored in the database are reused). The error of the solution u_k is estimated by Richardson extrapolation:
+   * with d_k = |u_k - u_{k-1}| measured on the coarser grid (u_k restricted by injection, i.e. every other point), 
+   * the rate of convergence is p = log_2(d_{k-1}/d_k) and the error is |u - u_k| ~ d_k/(2^p - 1). The estimate 
+   * requires three successive levels and is only made while the differences decrease.
+   * 
+   * The estimates are stored as attributes "estimated_<norm>_rate" and "estimated_<norm>_error" of the "k = ..." datasets.
+   * The target and the outcome are stored as attributes "target_<norm>", "target_<norm>_refinement_exponent" (the first k 
+   * that meets the target, or the largest k tried), and "target_<norm>_met" (1 or 0) of the data group of the flux.
+   * 
+   * \param arguments Map containing valid initial condition name, flux name, maximal grid refinement exponent, norm, and target error
+   * \param solve Computes (and stores) the solution for the refinement exponent given in the arguments
+   */
+
+void target_accuracy(std::map<std::string, std::string> & arguments, std::valarray<double> (*solve)(std::map<std::string, std::string> &)) {
+
+  const unsigned int max_refinement_exponent = std::stoi(arguments["refinement_exponent"]);
+  const std::string norm = arguments["norm"];
+  const double target_error = std::stod(arguments["target_error"]);
+  const std::string group_path = "/" + arguments["initial_condition"] + "/" + arguments["flux"]; 
+
+// Solution on the previous (coarser) grid and its difference from the solution on the grid before it  
+  std::valarray<double> coarse_solution;
+  double coarse_difference = 0;
+  
+  unsigned int refinement_exponent = 6;
+  bool target_met = false;
+
+  for (; refinement_exponent <= max_refinement_exponent; ++refinement_exponent) 
+    {
+      arguments["refinement_exponent"] = std::to_string(refinement_exponent);
+
+      std::valarray<double> solution;
+      if (!read_solution(arguments, solution))
+	solution = solve(arguments);
+
+      if (refinement_exponent > 6)
+	{
+// Difference between the solutions on two successive grids, measured on the coarser grid  
+	  std::valarray<double> difference_vector = solution[std::slice(0, coarse_solution.size(), 2)];
+	  difference_vector -= coarse_solution;
+	  const double difference = grid_norm(difference_vector, norm);
+
+	  if (refinement_exponent > 7 and difference < coarse_difference)
+	    {
+	      const double rate = std::log2(coarse_difference/difference);
+	      const double error = difference/(std::pow(2, rate) - 1);
+	      
+	      H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDWR);
+	      H5::DataSet field_dataset = computations_output_file.openDataSet(group_path + "/k = " + arguments["refinement_exponent"]);
+	      write_attribute(field_dataset, "estimated_" + norm + "_rate", rate);
+	      write_attribute(field_dataset, "estimated_" + norm + "_error", error);
+
+	      std::cout << group_path << "/k = " << refinement_exponent << ": estimated " << norm << " error " << error << ", rate " << rate << std::endl;
+
+	      target_met = (error <= target_error);
+	    }
+
+	  coarse_difference = difference;
+	}
+
+      std::swap(coarse_solution, solution);
+
+      if (target_met)
+	break;
+    }
+
+  refinement_exponent = std::min(refinement_exponent, max_refinement_exponent);
+  
+  H5::H5File computations_output_file("output_database/computations_output.hdf5", H5F_ACC_RDWR);
+  H5::Group output_group = computations_output_file.openGroup(group_path);
+  write_attribute(output_group, "target_" + norm, target_error);
+  write_attribute(output_group, "target_" + norm + "_refinement_exponent", refinement_exponent);
+  write_attribute(output_group, "target_" + norm + "_met", target_met);
+
+  if (target_met)
+    std::cout << group_path << ": target " << norm << " error " << target_error << " met at k = " << refinement_exponent << std::endl;
+  else
+    std::cout << group_path << ": target " << norm << " error " << target_error << " not met up to k = " << refinement_exponent << std::endl;
+};
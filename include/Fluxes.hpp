@@ -18,11 +18,23 @@
 
 /*
  * NOTE:    
- * Statements involving negative indeces should be computed outside the loop 
- * to avoid segmentation fault, which probably occurs due to the exclusion
- * of memory corresponding to negative indeces from the memory page in 
- * which the operating system allows this process to operate. 
- * That probably happens due to the way the compiler arranges the loop.
+ * Statements involving negative indeces should be computed outside of loops with an
+ * unsigned counter: for i = 0 the expression i-1 wraps around to a huge unsigned value
+ * instead of -1, which results in a segmentation fault.
+*/
+
+/*
+ * NOTE:
+ * Fluxes whose stencil only reads the neighbouring cells of an edge (as opposed to
+ * fluxes which keep state over the whole grid, e.g. limiters or low-order estimates)
+ * set local_stencil to true and provide fluxes_range(first, last), which computes the
+ * fluxes at the edges [first, last) only. This allows the time stepping to process the
+ * grid in tiles (see tiled_timestep in Compute_task.hpp). The range is given as signed
+ * integers, so that the indeces i-1 and i-2 stay negative instead of wrapping around.
+ *
+ * The other fluxes provide fluxes_grid(N), which computes the fluxes at all edges of a grid
+ * of N cells. N is either the member M (operator()) or std::integral_constant<unsigned int, M>,
+ * which gives the loops a compile-time trip count (see compute_fluxes in Compute_task.hpp).
 */
  
 // Abstract class which serves as a blueprint for other classes of fluxes 
@@ -48,6 +60,10 @@ public:
   virtual void operator()() const = 0;
 // Empty destructor is sufficient, since no memory will be explicitly allocated on free store by these classes  
   virtual ~Flux_base() {};
+// Fluxes are not tileable unless the child class states otherwise
+  static constexpr bool local_stencil = false;
+// Fluxes for linear advection with constant speed a, unless the child class states otherwise
+  static constexpr bool nonlinear = false;
 // Protected means "will be inherited by children classes"
 protected:  
  const unsigned int M; 
@@ -70,13 +86,19 @@ public:
 	
   ~Upwind() {};  
   
-  void operator()() const 
+  static constexpr bool local_stencil = true;
+  
+  void fluxes_range(int first, int last) const 
   {
-      _fluxes[0] = a*_field[-1];
-      for(unsigned int i = 1; i < M; ++i) 
+      for(int i = first; i < last; ++i) 
 	{
 	  _fluxes[i] = a*_field[i-1];
 	}
+  };
+  
+  void operator()() const 
+  {
+      fluxes_range(0, M);
 // Periodic boundary condition for fluxes (cells 0 and M are identical) 
       _fluxes[M] = _fluxes[0];
   };
@@ -97,13 +119,19 @@ public:
 	
   ~Lax_Friedrichs() {};  
   
-  void operator()() const 
+  static constexpr bool local_stencil = true;
+  
+  void fluxes_range(int first, int last) const 
   {
-      _fluxes[0] = half_a*( (_field[-1] + _field[0]) + inv_CFL*(_field[-1] - _field[0]) );
-      for(unsigned int i = 1; i < M; ++i) 
+      for(int i = first; i < last; ++i) 
       {    
        _fluxes[i] = half_a*( (_field[i-1] + _field[i]) + inv_CFL*(_field[i-1] - _field[i]) );
       }
+  };
+  
+  void operator()() const 
+  {
+      fluxes_range(0, M);
 // Periodic boundary condition for fluxes (cells 0 and M are identical) 
       _fluxes[M] = _fluxes[0];
   };
@@ -127,13 +155,19 @@ public:
 	
   ~Lax_Wendroff() {};  
   
-  void operator()() const 
-  {  
-       _fluxes[0] = half_a*( (_field[0] + _field[-1]) + CFL*(_field[-1] - _field[0]) );
-      for(unsigned int i = 1; i < M; ++i) 
+  static constexpr bool local_stencil = true;
+  
+  void fluxes_range(int first, int last) const 
+  {
+      for(int i = first; i < last; ++i) 
       {    
        _fluxes[i] = half_a*( (_field[i] + _field[i-1]) + CFL*(_field[i-1] - _field[i]) );
       }
+  };
+  
+  void operator()() const 
+  {  
+       fluxes_range(0, M);
 // Periodic boundary condition for fluxes (cells 0 and M are identical) 
        _fluxes[M] = _fluxes[0];
   };
@@ -156,14 +190,19 @@ public:
 	
   ~Fromm() {};  
   
-  void operator()() const 
-  {   
-       _fluxes[0] = a*( _field[-1] + CFL_expr*(_field[0] - _field[-2]) );
-       _fluxes[1] = a*( _field[0] + CFL_expr*(_field[1] - _field[-1]) );
-      for(unsigned int i = 2; i < M; ++i) 
+  static constexpr bool local_stencil = true;
+  
+  void fluxes_range(int first, int last) const 
+  {
+      for(int i = first; i < last; ++i) 
       {    
        _fluxes[i] = a*( _field[i-1] + CFL_expr*(_field[i] - _field[i-2]) );
-      }      
+      }
+  };
+  
+  void operator()() const 
+  {   
+       fluxes_range(0, M);
 // Periodic boundary condition for fluxes (cells 0 and M are identical) 
        _fluxes[M] = _fluxes[0];
   };
@@ -191,27 +230,10 @@ public:
 	
   ~Fromm_van_Leer() {};  
 
-  void update_limiters() const 
+  template<typename Grid_size>
+  void update_limiters(Grid_size N) const 
   {
-     u1 = _field[-1] - _field[-2];
-     u2 = _field[0] - _field[-1];
-     u3 = 0.25*(u1 + u2);
-     sign_u3 = boost::math::sign<double>(u3);
-          
-     delta[0] = (u1*u2 > 0) ? 
-      sign_u3 * CFL_expr * std::min<double>({std::abs(u1), std::abs(u2), std::abs(u3)}) :
-      0;
-           
-     u1 = _field[0] - _field[-1];
-     u2 = _field[1] - _field[0];
-     u3 = 0.25*(u1 + u2);
-     sign_u3 = boost::math::sign<double>(u3);
-          
-     delta[1] = (u1*u2 > 0) ? 
-      sign_u3 * CFL_expr * std::min<double>({std::abs(u1), std::abs(u2), std::abs(u3)}) :
-      0;
-  
-    for(unsigned int i = 2; i < M; ++i) 
+    for(int i = 0; i < static_cast<int>(N); ++i) 
     {  
      u1 = _field[i-1] - _field[i-2];
      u2 = _field[i] - _field[i-1];
@@ -224,21 +246,25 @@ public:
     }
     
 // Periodic boundary condition for fluxes (cells 0 and M are identical) 
-     delta[M] = delta[0];
+     delta[N] = delta[0];
   }
   
-  void operator()() const 
+  template<typename Grid_size>
+  void fluxes_grid(Grid_size N) const 
   {        
-    update_limiters();
-          
-    _fluxes[0] = a*( _field[-1] + delta[0] );      
+    update_limiters(N);
      
-    for(unsigned int i = 1; i < M+1; ++i) 
+    for(int i = 0; i < static_cast<int>(N)+1; ++i) 
      {
       _fluxes[i] = a*( _field[i-1] + delta[i] );
      }     
       
   };
+  
+  void operator()() const 
+  {
+    fluxes_grid(M);
+  };
     
 private:
   const double CFL_expr;     
@@ -272,37 +298,41 @@ public:
   
   ~Flux_Corrected_Transport() {};  
     
-  void anti_diffusive_fluxes() const 
+  template<typename Grid_size>
+  void anti_diffusive_fluxes(Grid_size N) const 
   {
     _anti_diffusive_fluxes[0] = CFL_expr*( _field[0] - _field[-1] );
-   for(unsigned int i = 1; i < M; ++i) 
+   for(unsigned int i = 1; i < N; ++i) 
     {
      _anti_diffusive_fluxes[i] = CFL_expr*( _field[i] - _field[i-1] );
     }    
 // Periodic boundary condition for fluxes (cells 0 and M are identical)     
-   _anti_diffusive_fluxes[M] = _anti_diffusive_fluxes[0];
+   _anti_diffusive_fluxes[N] = _anti_diffusive_fluxes[0];
   }  
  
-  void low_order_estimate() const 
+  template<typename Grid_size>
+  void low_order_estimate(Grid_size N) const 
   {
-  low_order_fluxes();
+  low_order_fluxes.fluxes_range(0, N);
+  _fluxes[N] = _fluxes[0];
 
-  for(unsigned int i = 0; i < M; ++i) 
+  for(unsigned int i = 0; i < N; ++i) 
     {
       _field[i] += t_over_h*(_fluxes[i] - _fluxes[i+1]);
     }       
    
-  _field[-1] = _field[M-1];
-  _field[-2] = _field[M-2];
-  _field[M] = _field[0];
-  _field[M+1] = _field[1];
+  _field[-1] = _field[N-1];
+  _field[-2] = _field[N-2];
+  _field[N] = _field[0];
+  _field[N+1] = _field[1];
   }
   
-  void operator()() const 
+  template<typename Grid_size>
+  void fluxes_grid(Grid_size N) const 
   {
 
-    anti_diffusive_fluxes();  
-    low_order_estimate();
+    anti_diffusive_fluxes(N);  
+    low_order_estimate(N);
     
       S = boost::math::sign<double>(_anti_diffusive_fluxes[0]);
       A1 = S * h_over_t * (_field[1] - _field[0]);
@@ -318,7 +348,7 @@ public:
       theta = std::min<double>({ A1, A2, A3 });
      _fluxes[0] = S * std::max<double>({0, theta});
      
-    for(unsigned int i = 2; i < M-1; ++i) 
+    for(unsigned int i = 2; i < N-1; ++i) 
      {
       S = boost::math::sign<double>(_anti_diffusive_fluxes[i]);
       A1 = S * h_over_t * (_field[i+1] - _field[i]);
@@ -328,15 +358,20 @@ public:
      _fluxes[i] = S * std::max<double>({0, theta});
      }
      
-      S = boost::math::sign<double>(_anti_diffusive_fluxes[M-1]);
-      A1 = S * h_over_t * (_field[M] - _field[M-1]);
-      A2 = S * h_over_t * (_field[M-2] - _field[M-3]); 
-      A3 = S * _anti_diffusive_fluxes[M-1];
+      S = boost::math::sign<double>(_anti_diffusive_fluxes[N-1]);
+      A1 = S * h_over_t * (_field[N] - _field[N-1]);
+      A2 = S * h_over_t * (_field[N-2] - _field[N-3]); 
+      A3 = S * _anti_diffusive_fluxes[N-1];
       theta = std::min<double>({ A1, A2, A3 });
-     _fluxes[M-1] = S * std::max<double>({0, theta});
+     _fluxes[N-1] = S * std::max<double>({0, theta});
      
 // Periodic boundary condition for fluxes (cells 0 and M are identical)       
-     _fluxes[M] = _fluxes[0]; 
+     _fluxes[N] = _fluxes[0]; 
+  };
+  
+  void operator()() const 
+  {
+    fluxes_grid(M);
   };
     
 private:
@@ -373,23 +408,12 @@ public:
 	
   ~Lax_Wendroff_Fourth_Order() {};  
   
-  void operator()() const 
+  static constexpr bool local_stencil = true;
+  
+  void fluxes_range(int first, int last) const 
   {
 // NOTE: The convergence will be 3-rd order if _fluxes[i] = D;
-
-  u_n = alpha*(_field[0] + _field[-1]) - beta*(_field[1] + _field[-2]);
-  F = u_n - half_CFL * (gamma * (_field[0] - _field[-1]) - beta * (_field[1] - _field[-2]) );
-  D = CFL_expr * ( ( _field[1] - _field[-2] ) - 3*( _field[0] - _field[-1]) );
-  
-  _fluxes[0] = F + D;
-
-  u_n = alpha*(_field[1] + _field[0]) - beta*(_field[2] + _field[-1]);
-  F = u_n - half_CFL * (gamma * (_field[1] - _field[0]) - beta * (_field[2] - _field[-1]) );
-  D = CFL_expr * ( ( _field[2] - _field[-1] ) - 3*( _field[1] - _field[0]) );
-  
-  _fluxes[1] = F + D;
-  
-  for(unsigned int i = 2; i < M; ++i) 
+  for(int i = first; i < last; ++i) 
     {    
     u_n = alpha*(_field[i] + _field[i-1]) - beta*(_field[i+1] + _field[i-2]);
     F = u_n - half_CFL * (gamma * (_field[i] - _field[i-1]) - beta * (_field[i+1] - _field[i-2]) );
@@ -397,6 +421,11 @@ public:
     
     _fluxes[i] = F + D;
     }
+  };
+  
+  void operator()() const 
+  {
+  fluxes_range(0, M);
   
 // Periodic boundary condition for fluxes (cells 0 and M are identical) 
   _fluxes[M] = _fluxes[0];
@@ -412,4 +441,136 @@ private:
   mutable double u_n;
   mutable double F;
   mutable double D;
-};
\ No newline at end of file
+};
+
+/*
+ * NOTE:
+ * Nonlinear scalar conservation laws u_t + f(u)_x = 0 are described by three policies:
+ *   flux function     - f(u), its derivative f'(u), and the sonic point u_s where f'(u_s) = 0
+ *                       (f is assumed to be convex, which is the case for Burgers' equation)
+ *   numerical flux    - F(u_l, u_r) computed from the states on both sides of an edge
+ *   reconstruction    - the states u_l and u_r at an edge computed from the cell averages
+ * Everything is written in terms of the arithmetic selects max_value/min_value below, so that the loops
+ * over the edges have no branches and are vectorized by the compiler: std::max/std::min and the ?: operator
+ * compile to a compare and branch, which is not if-converted for double without -ffast-math.
+ * The max|f'(u)| reductions are vectorized with per-lane partial maxima (omp simd, enabled by -fopenmp-simd).
+ * 
+ * The speed a has no meaning for nonlinear laws: the timestep is adapted to max|f'(u)| instead,
+ * so that the CFL number is kept constant (see main_loop_nonlinear in Compute_task.hpp).
+*/
+
+// Branchless max(x, y) and min(x, y); exact if x or y is zero, otherwise rounded to within one ulp
+inline double max_value(double x, double y) { return 0.5*(x + y + std::abs(x - y)); }
+inline double min_value(double x, double y) { return 0.5*(x + y - std::abs(x - y)); }
+
+// Inviscid Burgers' equation: f(u) = u^2/2 
+struct Burgers_equation {
+  static double f(double u) { return 0.5*u*u; };
+  static double df(double u) { return u; };
+  static double sonic_point() { return 0; };
+};
+
+// Exact Godunov flux for convex flux function: F = max( f(max(u_l, u_s)), f(min(u_r, u_s)) )
+template<typename Flux_function>
+struct Godunov {
+  typedef Flux_function flux_function;
+  
+  static double F(double u_l, double u_r) 
+  { 
+    return max_value(Flux_function::f(max_value(u_l, Flux_function::sonic_point())), 
+		     Flux_function::f(min_value(u_r, Flux_function::sonic_point()))); 
+  };
+};
+
+// Engquist-Osher flux for convex flux function: F = f(max(u_l, u_s)) + f(min(u_r, u_s)) - f(u_s)
+template<typename Flux_function>
+struct Engquist_Osher {
+  typedef Flux_function flux_function;
+  
+  static double F(double u_l, double u_r) 
+  { 
+    return Flux_function::f(max_value(u_l, Flux_function::sonic_point())) 
+	 + Flux_function::f(min_value(u_r, Flux_function::sonic_point())) 
+	 - Flux_function::f(Flux_function::sonic_point()); 
+  };
+};
+
+// First order: the states at the i-th edge are the averages of the (i-1)-th and i-th cells
+struct Piecewise_constant {
+  static double left(const double * u, int i) { return u[i-1]; };
+  static double right(const double * u, int i) { return u[i]; };
+};
+
+// Second order: piecewise linear reconstruction with minmod limited slopes (TVD for CFL <= 0.5)
+struct Minmod {
+  static double minmod(double x, double y) 
+  { 
+    return 0.5*(std::copysign(1.0, x) + std::copysign(1.0, y))*min_value(std::abs(x), std::abs(y)); 
+  };
+  static double left(const double * u, int i) { return u[i-1] + 0.5*minmod(u[i-1] - u[i-2], u[i] - u[i-1]); };
+  static double right(const double * u, int i) { return u[i] - 0.5*minmod(u[i] - u[i-1], u[i+1] - u[i]); };
+};
+
+template<typename Numerical_flux, typename Reconstruction>
+class Conservation_law : public Flux_base {
+public:
+  Conservation_law(unsigned int M = 0, 
+	 double CFL = 0.9, 
+	 double a = 3.0, 
+	 double * _fluxes = nullptr, 
+	 double * _field = nullptr
+	) : 
+	Flux_base(M, CFL, a, _fluxes, _field) 
+	{};  
+	
+  ~Conservation_law() {};  
+  
+  static constexpr bool nonlinear = true;
+  
+  typedef typename Numerical_flux::flux_function flux_function;
+  
+  template<typename Grid_size>
+  void fluxes_grid(Grid_size N) const 
+  {
+      for(int i = 0; i < static_cast<int>(N); ++i) 
+	{
+	  _fluxes[i] = Numerical_flux::F(Reconstruction::left(_field, i), Reconstruction::right(_field, i));
+	}
+// Periodic boundary condition for fluxes (cells 0 and M are identical) 
+      _fluxes[N] = _fluxes[0];
+  };
+  
+  void operator()() const 
+  {
+      fluxes_grid(M);
+  };
+  
+// Maximal wave speed max|f'(u)| over the grid
+  template<typename Grid_size>
+  double max_wave_speed(Grid_size N) const
+  {
+      double speed = 0;
+#pragma omp simd reduction(max:speed)
+      for(unsigned int i = 0; i < N; ++i) 
+	speed = std::max(speed, std::abs(flux_function::df(_field[i])));
+      return speed;
+  };
+
+// Conservative update of the scalar field fused with the reduction max|f'(u)| over the updated field, which determines the next timestep  
+  template<typename Grid_size>
+  double update_field(double t_over_h, Grid_size N) const
+  {
+      double speed = 0;
+#pragma omp simd reduction(max:speed)
+      for(unsigned int i = 0; i < N; ++i) 
+	{
+	  _field[i] += t_over_h*(_fluxes[i] - _fluxes[i+1]);
+	  speed = std::max(speed, std::abs(flux_function::df(_field[i])));
+	}
+      return speed;
+  };
+};
+
+typedef Conservation_law<Godunov<Burgers_equation>, Piecewise_constant> Burgers_Godunov;
+typedef Conservation_law<Engquist_Osher<Burgers_equation>, Piecewise_constant> Burgers_Engquist_Osher;
+typedef Conservation_law<Godunov<Burgers_equation>, Minmod> Burgers_Godunov_Minmod;
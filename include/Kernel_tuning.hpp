@@ -0,0 +1,177 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+/*
+ * NOTE:
+ * Kernel variants differ in the way one timestep traverses the grid:
+ *   "split"      - compute the fluxes at all edges, then update all cells
+ *   "tiled_<B>"  - compute the fluxes and update the cells tile by tile, B cells at a time,
+ *                  so that the fluxes of a tile are still in cache when the tile is updated
+ * Tiled variants are only available for fluxes with local_stencil (see Fluxes.hpp).
+ *
+ * The fastest variant for every (flux, refinement exponent) pair is found by short timed
+ * trial runs (see autotune in Compute_task.hpp) and stored in the tuning file, one record per line:
+ *   CPU model <TAB> flux <TAB> refinement exponent <TAB> variant
+ * Records of other CPU models are kept intact, so that one tuning file can serve several machine types.
+ * The tuning file is replaced by renaming a complete temporary file, so that a computation never reads a
+ * partially written file; autotuning processes serialize the update on the lock file next to it.
+*/
+
+/** @brief Path to the file in which the selected kernel variants are stored. */
+const std::string tuning_file_path = "output_database/kernel_tuning.txt";
+
+/** @brief Tile sizes (in cells) tried by the autotuner for the tiled kernel variants. */
+const std::vector<unsigned int> tile_sizes {256, 1024, 4096};
+
+  /**
+   * \brief Name of the CPU model of the machine, used as a key in the tuning file.
+   *
+   * @return The "model name" entry of /proc/cpuinfo, or "Unknown" if it is not available.
+   */
+
+std::string cpu_model() {
+
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+
+  while (std::getline(cpuinfo, line))
+    {
+      if (line.compare(0, 10, "model name") != 0)
+	continue;
+// Strip the key, the colon and the leading whitespace
+      std::string::size_type position = line.find(':');
+      if (position == std::string::npos)
+	break;
+      position = line.find_first_not_of(" \t", position+1);
+      if (position == std::string::npos)
+	break;
+      return line.substr(position);
+    }
+
+  return "Unknown";
+};
+
+  /**
+   * \brief Kernel variants which are available for the given flux and grid size.
+   *
+   * \param local_stencil True if the flux can be computed on a subrange of edges @see Flux_base
+   * \param M Number of cells in the discretization of the grid
+   *
+   * @return List of kernel variant names; "split" always comes first.
+   */
+
+std::vector<std::string> kernel_variants(bool local_stencil, unsigned int M) {
+
+  std::vector<std::string> variants {"split"};
+
+// Tiles as large as the whole grid are equivalent to the split variant
+  if (local_stencil)
+    for (unsigned int tile : tile_sizes)
+      if (tile < M)
+	variants.push_back("tiled_" + std::to_string(tile));
+
+  return variants;
+};
+
+  /**
+   * \brief Tile size of the given kernel variant, which must be one of kernel_variants(...).
+   *
+   * @return Number of cells in one tile, or 0 for the split variant.
+   */
+
+unsigned int tile_size(const std::string & variant) {
+
+  if (variant.compare(0, 6, "tiled_") == 0)
+    return std::stoi(variant.substr(6));
+
+  return 0;
+};
+
+  /**
+   * \brief Retrieve the kernel variant selected by the autotuner for this machine.
+   *
+   * \param flux Valid flux name
+   * \param refinement_exponent Grid refinement exponent
+   * \param local_stencil True if the flux can be computed on a subrange of edges @see Flux_base
+   * \param M Number of cells in the discretization of the grid
+   *
+   * @return Name of the selected kernel variant, or "split" if the tuning file has no valid record for this machine, flux and grid size.
+   */
+
+std::string load_kernel_variant(const std::string & flux, const std::string & refinement_exponent, bool local_stencil, unsigned int M) {
+
+  std::ifstream tuning_file(tuning_file_path);
+  std::string line;
+  const std::string key = cpu_model() + "\t" + flux + "\t" + refinement_exponent + "\t";
+
+  while (std::getline(tuning_file, line))
+    if (line.compare(0, key.size(), key) == 0)
+      {
+// Malformed records and variants which are not available for this flux and grid size are ignored  
+	const std::vector<std::string> variants = kernel_variants(local_stencil, M);
+	const std::string variant = line.substr(key.size());
+	if (std::find(variants.begin(), variants.end(), variant) != variants.end())
+	  return variant;
+	break;
+      }
+
+  return "split";
+};
+
+  /**
+   * \brief Record the kernel variant selected by the autotuner for this machine in the tuning file.
+   *
+   * An existing record for the same machine, flux and grid size is replaced; all other records are kept.
+   *
+   * \param flux Valid flux name
+   * \param refinement_exponent Grid refinement exponent
+   * \param variant Name of the selected kernel variant
+   */
+
+void store_kernel_variant(const std::string & flux, const std::string & refinement_exponent, const std::string & variant) {
+
+  const std::string key = cpu_model() + "\t" + flux + "\t" + refinement_exponent + "\t";
+
+// Exclusive lock held until the updated tuning file is in place, so that concurrent autotuning processes do not lose each other's records  
+  const std::string lock_path = tuning_file_path + ".lock";
+  const int lock_descriptor = open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock_descriptor < 0 or flock(lock_descriptor, LOCK_EX) != 0)
+    throw std::runtime_error("\n\tCannot lock the tuning file \"" + lock_path + "\"");
+
+// Read all records except the one that is being replaced
+  std::stringstream records;
+  std::ifstream input_tuning_file(tuning_file_path);
+  std::string line;
+
+  while (std::getline(input_tuning_file, line))
+    if (line.compare(0, key.size(), key) != 0)
+      records << line << "\n";
+  input_tuning_file.close();
+
+  records << key << variant << "\n";
+
+// Write the records into a temporary file and replace the tuning file with it  
+  const std::string temporary_path = tuning_file_path + ".tmp." + std::to_string(getpid());
+  std::ofstream output_tuning_file(temporary_path, std::ios::trunc);
+  output_tuning_file << records.str();
+  output_tuning_file.close();
+
+  const bool replaced = output_tuning_file and (std::rename(temporary_path.c_str(), tuning_file_path.c_str()) == 0);
+  if (!replaced)
+    std::remove(temporary_path.c_str());
+
+  close(lock_descriptor);
+
+  if (!replaced)
+    throw std::runtime_error("\n\tCannot write the tuning file \"" + tuning_file_path + "\"");
+};
@@ -0,0 +1,163 @@
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * NOTE:
+ * Alternative to the HDF5 database for the results of computations: every result is a separate
+ * .npy file (format version 1.0) in npy_directory, which can be opened without copying by
+ *   numpy.load(path, mmap_mode='r')
+ * The file is mapped into memory, so that the solver writes the final state of the scalar field
+ * directly into the mapped pages (see timestep in Compute_task.hpp). The pages are not flushed
+ * explicitly: readers see them through the page cache as soon as the file is renamed, and the kernel
+ * writes them back in the background (the result is not protected against a system crash).
+ *
+ * Processes never share a result file, hence no file-level lock is needed:
+ *  - a result is written to a temporary file named after the process and renamed to its final name
+ *    when it is complete, so that readers never see a partially written result;
+ *  - the attributes of the computation are recorded in the index file, one line per result
+ *      file name <TAB> CFL <TAB> a <TAB> T
+ *    and every line is appended with a single write() to a file opened with O_APPEND,
+ *    which does not interleave with the lines of other processes.
+ * The HDF5 database is only opened briefly, read-only, before the computation (see read_initial_data in
+ * Compute_task.hpp). HDF5 locks the file while it is open, so computations in the Npy mode run concurrently
+ * with each other, but one of them fails to start while another process has the database open for writing,
+ * e.g. a computation in another mode which is storing its result.
+*/
+
+/** @brief Path to the directory in which the .npy results and their index file are stored. */
+const std::string npy_directory = "output_database/npy";
+
+/** @brief Path to the index file recording the attributes of the .npy results. */
+const std::string npy_index_path = npy_directory + "/index.txt";
+
+// Exception describing the failed system call
+std::runtime_error npy_error(const std::string & what, const std::string & path) {
+
+  return std::runtime_error("\n\t" + what + " \"" + path + "\": " + std::strerror(errno));
+};
+
+class Npy_output {
+public:
+// Create the temporary file for a one-dimensional array of M doubles and map it into memory
+  Npy_output(const std::string & file_name, unsigned int M) :
+	   path(npy_directory + "/" + file_name),
+	   temporary_path(path + ".tmp." + std::to_string(getpid())),
+	   header(npy_header(M)),
+	   size(header.size() + M*sizeof(double)),
+	   descriptor(-1),
+	   mapping(nullptr)
+	   {
+	     if (mkdir(npy_directory.c_str(), 0755) != 0 and errno != EEXIST)
+	       throw npy_error("Cannot create directory", npy_directory);
+
+	     descriptor = open(temporary_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	     if (descriptor < 0)
+	       throw npy_error("Cannot create file", temporary_path);
+
+	     if (ftruncate(descriptor, size) != 0)
+	       {
+	         const std::runtime_error error = npy_error("Cannot resize file", temporary_path);
+	         discard();
+	         throw error;
+	       }
+
+	     void * pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	     if (pages == MAP_FAILED)
+	       {
+	         const std::runtime_error error = npy_error("Cannot map file", temporary_path);
+	         discard();
+	         throw error;
+	       }
+	     mapping = static_cast<char *>(pages);
+
+	     std::memcpy(mapping, header.data(), header.size());
+	   };
+
+// A result which has not been committed is discarded
+  ~Npy_output()
+  {
+    discard();
+  };
+
+  Npy_output(const Npy_output &) = delete;
+  Npy_output & operator=(const Npy_output &) = delete;
+
+// Mapped array of M doubles
+  double * data() const { return reinterpret_cast<double *>(mapping + header.size()); };
+
+// Publish the file under its final name and record its attributes in the index file
+  void commit(double S, double a, double T)
+  {
+    if (rename(temporary_path.c_str(), path.c_str()) != 0)
+      {
+	const std::runtime_error error = npy_error("Cannot rename file", temporary_path);
+	discard();
+	throw error;
+      }
+
+    munmap(mapping, size);
+    mapping = nullptr;
+    close(descriptor);
+    descriptor = -1;
+
+    std::ostringstream record;
+    record.precision(17);
+    record << path.substr(npy_directory.size() + 1) << "\t" << S << "\t" << a << "\t" << T << "\n";
+
+    const int index_descriptor = open(npy_index_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (index_descriptor < 0)
+      throw npy_error("Cannot open index file", npy_index_path);
+    const std::string line = record.str();
+    const bool written = (write(index_descriptor, line.data(), line.size()) == static_cast<ssize_t>(line.size()));
+    close(index_descriptor);
+    if (!written)
+      throw npy_error("Cannot write index file", npy_index_path);
+  };
+
+private:
+// Release the mapping and the descriptor and remove the temporary file, unless the result has been committed
+  void discard()
+  {
+    if (mapping != nullptr)
+      munmap(mapping, size);
+    mapping = nullptr;
+    if (descriptor >= 0)
+      {
+	close(descriptor);
+	unlink(temporary_path.c_str());
+      }
+    descriptor = -1;
+  };
+
+// Header of the .npy format 1.0: magic string, version, header length, and the array description padded to a multiple of 64 bytes
+  static std::string npy_header(unsigned int M)
+  {
+    const unsigned int one = 1;
+    const bool little_endian = (*reinterpret_cast<const unsigned char *>(&one) == 1);
+
+    std::string description = std::string("{'descr': '") + (little_endian ? "<" : ">") + "f8', 'fortran_order': False, 'shape': (" + std::to_string(M) + ",), }";
+    const std::string::size_type preamble = 10;
+    description.append(63 - (preamble + description.size()) % 64, ' ');
+    description.push_back('\n');
+
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header.push_back(static_cast<char>(description.size() & 0xff));
+    header.push_back(static_cast<char>(description.size() >> 8));
+    return header + description;
+  };
+
+  const std::string path;
+  const std::string temporary_path;
+  const std::string header;
+  const std::size_t size;
+  int descriptor;
+  char * mapping;
+};
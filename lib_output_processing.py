@@ -38,6 +38,9 @@ from lxml import etree
 ## Path to the HDF5 database in which the computational data is stored.   
 database_path = "output_database/computations_output.hdf5"
 
+## Path to the directory in which the results of computations in the "Npy" mode are stored as .npy files.
+npy_path = "output_database/npy/"
+
 ## Path to the website directory where the generated HTML documents will be written
 html_path = "website/"
 
@@ -62,6 +65,14 @@ fluxes = [
  "Lax_Wendroff_Fourth_Order"    
   ]
 
+## Valid fluxes input strings for the inviscid Burgers' equation. Their solutions are not translates of the initial data, 
+## hence they are computed with adaptive timestep and excluded from the convergence tables.
+nonlinear_fluxes = [
+ "Burgers_Godunov", 
+ "Burgers_Engquist_Osher", 
+ "Burgers_Godunov_Minmod"
+  ]
+
 ## Header strings for the convergence table
 convergence_table_header_data = { 
  "k" : "k",
@@ -155,6 +166,19 @@ def create_output_database():
     else:
      computations_database[group_path].attrs["CFL"] = 0.9
      
+# Burgers' equation: the timestep adapts to the maximal wave speed, hence "a" is not used;
+# the output time is chosen after the formation of shocks. The sequence of timesteps of each computation
+# is stored in the dataset "k = ... time_steps" next to the solution.
+   for flux in nonlinear_fluxes:     
+    group_path = initial_condition + "/" + flux
+    computations_database.create_group(group_path)
+    computations_database[group_path].attrs["a"] = 1.0
+    computations_database[group_path].attrs["T"] = 0.5
+    if flux == "Burgers_Godunov_Minmod": 
+     computations_database[group_path].attrs["CFL"] = 0.5
+    else:
+     computations_database[group_path].attrs["CFL"] = 0.9
+     
   computations_database.close()   
   print("DATABASE STATUS:")
   print("\t" + database_path + " has been created and is ready to store the results of computations")
@@ -379,6 +403,32 @@ def computation_attributes(initial_condition, flux):
  
  return attributes
 
+def npy_result(initial_condition, flux, k):  
+ """!
+ @brief Retreive the result of a computation in the "Npy" mode together with its attributes.
+
+ @param initial_condition One of the valid initial conditions. @see initial_conditions
+
+ @param flux One of the valid fluxes. @see fluxes
+
+ @param k Grid refinement exponent
+
+ @return Read-only memory-mapped array of the final state of the scalar field, and dictionary of attributes pertaining to the computation.
+  """ 
+ 
+ file_name = initial_condition + "_" + flux + "_k_" + str(k) + ".npy"
+ 
+ attributes = {}
+ with open(npy_path + "index.txt") as index_file:
+  for line in index_file:
+   record = line.split("\t")
+   if record[0] == file_name:
+    attributes["CFL"] = float(record[1])
+    attributes["a"] = float(record[2])
+    attributes["T"] = float(record[3])
+ 
+ return numpy.load(npy_path + file_name, mmap_mode = "r"), attributes
+
 def create_convergence_table(initial_condition, flux):
  """! 
 
@@ -35,7 +35,11 @@
  *  
  * The syntax for executing a particular computational task is:
  * 
- * <ul><li>./compute_task "Initial Condition" "Flux" "Refinement Exponent"</li></ul>
+ * <ul>
+ *  <li>./compute_task "Initial Condition" "Flux" "Refinement Exponent" ["Autotune" | "Npy"]</li>
+ *  <li>./compute_task "Initial Condition" "Flux" "Refinement Exponent" "Sparse" "Activity Threshold"</li>
+ *  <li>./compute_task "Initial Condition" "Flux" "Maximal Refinement Exponent" "Target_Accuracy" "Norm" "Target Error"</li>
+ * </ul>
  * 
  * 
  * The sequence of tasks is programmed in the file "execute_tasks.py" using python syntax and functions 
@@ -51,6 +55,22 @@
  * \param Flux Valid flux input string @see fluxes
  * 
  * \param Refinement_Exponent Valid grid stepsize; refinement exponent is related to grid stepsize as h = 2^(-Refinement_Exponent)
+ * 
+ * \param Mode Optional; "Autotune" runs short timed trials of the available kernel variants and records the fastest one
+ * for this machine, flux and grid size in "output_database/kernel_tuning.txt". Subsequent computations on the same CPU model
+ * use the recorded variant. @see modes
+ * 
+ * \param Npy Store the solution as "output_database/npy/<Initial Condition>_<Flux>_k_<Refinement Exponent>.npy" instead of
+ * the HDF5 database; the file can be loaded with numpy.load(path, mmap_mode='r'), and its CFL number, a and T are recorded
+ * in "output_database/npy/index.txt". The database is only read before the computation, so that computations in the Npy mode
+ * can run concurrently with each other. @see Npy_output
+ * 
+ * \param Sparse Skip the blocks of the grid in which the solution stays below "Activity Threshold" in absolute value; the fraction
+ * of executed cell updates and the resulting change of mass are reported and stored with the solution, which is written to the
+ * dataset "k = Refinement_Exponent sparse", apart from the result of the full computation. @see Activity_tracker
+ * 
+ * \param Target_Accuracy Instead of a single computation, compute k = 6, 7, ... and stop at the first grid whose error, estimated
+ * by Richardson extrapolation, is below "Target Error" in "Norm" (sup_norm, one_norm, or two_norm). @see target_accuracy
  *  
  * \par Analysis of the computational results:
  * 
@@ -63,24 +83,69 @@
 #include <map>
 #include "Compute_task.hpp"
 
+/** 
+ * \brief Select the grid size based on the input task: the kernels are instantiated for every valid
+ * refinement exponent, so that the number of cells M = 2^k is a compile-time constant.
+ */
+
+template<typename Flux>
+std::valarray<double> select_refinement_exponent(std::map<std::string, std::string> & arguments) {
+
+  switch (std::stoi(arguments["refinement_exponent"])) {
+    case 6: return execute_task<Flux, 6>(arguments);
+    case 7: return execute_task<Flux, 7>(arguments);
+    case 8: return execute_task<Flux, 8>(arguments);
+    case 9: return execute_task<Flux, 9>(arguments);
+    case 10: return execute_task<Flux, 10>(arguments);
+    case 11: return execute_task<Flux, 11>(arguments);
+    case 12: return execute_task<Flux, 12>(arguments);
+    case 13: return execute_task<Flux, 13>(arguments);
+    case 14: return execute_task<Flux, 14>(arguments);
+    case 15: return execute_task<Flux, 15>(arguments);
+    case 16: return execute_task<Flux, 16>(arguments);
+  }
+  
+  return std::valarray<double>();
+};
+
+/** 
+ * \brief Execute a single task, or in the target accuracy mode the sequence of tasks k = 6, 7, ... which ends at the first 
+ * grid that meets the target error.
+ */
+
+template<typename Flux>
+void select_mode(std::map<std::string, std::string> & arguments) {
+
+  if (arguments["mode"] == "Target_Accuracy")
+    target_accuracy(arguments, &select_refinement_exponent<Flux>);
+  else
+    select_refinement_exponent<Flux>(arguments);
+};
+
 int main(int argc, char **argv) {
 
 // Process and validate arguments  
   std::map<std::string, std::string> arguments = process_arguments(argc, argv);
 
-// Select the flux based on the input task and execute the computation  
+// Select the flux and the grid size based on the input task and execute the computation (or autotune its kernel)  
   if (arguments["flux"] == "Upwind") 
-   main_loop<Upwind>(arguments); 
+   select_mode<Upwind>(arguments); 
   else if (arguments["flux"] == "Lax_Friedrichs") 
-   main_loop<Lax_Friedrichs>(arguments); 
+   select_mode<Lax_Friedrichs>(arguments); 
   else if (arguments["flux"] == "Lax_Wendroff") 
-   main_loop<Lax_Wendroff>(arguments); 
+   select_mode<Lax_Wendroff>(arguments); 
   else if (arguments["flux"] == "Fromm" or arguments["flux"] == "Fromm_CFL_half") 
-   main_loop<Fromm>(arguments); 
+   select_mode<Fromm>(arguments); 
   else if (arguments["flux"] == "Fromm_van_Leer" or arguments["flux"] == "Fromm_van_Leer_CFL_half") 
-   main_loop<Fromm_van_Leer>(arguments); 
+   select_mode<Fromm_van_Leer>(arguments); 
   else if (arguments["flux"] == "Flux_Corrected_Transport") 
-   main_loop<Flux_Corrected_Transport>(arguments); 
+   select_mode<Flux_Corrected_Transport>(arguments); 
   else if (arguments["flux"] == "Lax_Wendroff_Fourth_Order") 
-   main_loop<Lax_Wendroff_Fourth_Order>(arguments);     
+   select_mode<Lax_Wendroff_Fourth_Order>(arguments);     
+  else if (arguments["flux"] == "Burgers_Godunov") 
+   select_mode<Burgers_Godunov>(arguments);     
+  else if (arguments["flux"] == "Burgers_Engquist_Osher") 
+   select_mode<Burgers_Engquist_Osher>(arguments);     
+  else if (arguments["flux"] == "Burgers_Godunov_Minmod") 
+   select_mode<Burgers_Godunov_Minmod>(arguments);     
 } 